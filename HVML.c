@@ -1,12 +1,23 @@
 // Post: https://x.com/VictorTaelin/status/1854326873590792276
 // Note: The atomics must be kept.
 // Note: This will segfault on non-Apple devices due to upfront mallocs.
+// Note: Pass a worker count (`./HVML 4`) to use a shared heap instead.
+// Note: Pass `-c` and a thread count (`./HVML -c 4`) to collapse superpositions.
+
+#define _GNU_SOURCE
 
 #include <stdint.h>
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
 #include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 typedef uint8_t  Tag;
 typedef uint32_t Lab;
@@ -26,6 +37,9 @@ typedef struct {
   a64*   ini; // memory first index (not used)
   a64*   end; // memory alloc index
   a64*   itr; // interaction count
+  a64*   hlt; // halt flag (stops normal)
+  int    shm; // shared segment fd (-1 if private)
+  Loc    pid; // owner of the dup values this process holds
 } Heap;
 
 // Constants
@@ -39,9 +53,15 @@ typedef struct {
 #define LAM 0x05
 #define SUP 0x06
 #define SUB 0x07
+#define LCK 0x08
 
 #define VOID 0x00000000000000
 
+#define HLT_STOP 1 // stopped on purpose (collapse found a branch)
+#define HLT_PSN  2 // poisoned by a worker that died mid-interaction
+
+#define MAX_WORKERS 256
+
 // Initialization
 // --------------
 
@@ -52,12 +72,93 @@ Heap* new_heap() {
   heap->ini  = malloc(sizeof(a64));
   heap->end  = malloc(sizeof(a64));
   heap->itr  = malloc(sizeof(a64));
+  heap->hlt  = malloc(sizeof(a64));
   atomic_store_explicit(heap->ini, 0, memory_order_relaxed);
   atomic_store_explicit(heap->end, 1, memory_order_relaxed);
   atomic_store_explicit(heap->itr, 0, memory_order_relaxed);
+  atomic_store_explicit(heap->hlt, 0, memory_order_relaxed);
+  heap->shm  = -1;
+  heap->pid  = 0;
+  return heap;
+}
+
+// Shared Heap
+// -----------
+
+// A shared heap places `ini`, `end`, `itr`, `hlt` and `mem` in one memfd segment:
+//   [ini][end][itr][hlt][...pad...][mem...]
+// Every process that maps it reduces the same graph, while keeping its own
+// private evaluation stack. Forked workers inherit the mapping; an unrelated
+// process can attach by opening `/proc/<pid>/fd/<heap->shm>` of the creator
+// and passing that fd to `attach_heap`.
+
+#define SHM_HEAD 8
+#define SHM_SIZE ((SHM_HEAD + (1ULL << 32)) * sizeof(ATerm))
+
+Term* new_stack() {
+  Term* stk = mmap(NULL, (1ULL << 32) * sizeof(Term), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return stk == MAP_FAILED ? NULL : stk;
+}
+
+void free_stack(Term* stk) {
+  munmap(stk, (1ULL << 32) * sizeof(Term));
+}
+
+Heap* attach_heap(int shm) {
+  a64* seg = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, shm, 0);
+  if (seg == MAP_FAILED) {
+    return NULL;
+  }
+  Term* stk = new_stack();
+  if (stk == NULL) {
+    munmap(seg, SHM_SIZE);
+    return NULL;
+  }
+  Heap* heap = malloc(sizeof(Heap));
+  heap->stk  = stk;
+  heap->mem  = (ATerm*)(seg + SHM_HEAD);
+  heap->ini  = seg + 0;
+  heap->end  = seg + 1;
+  heap->itr  = seg + 2;
+  heap->hlt  = seg + 3;
+  heap->shm  = shm;
+  heap->pid  = getpid();
   return heap;
 }
 
+Heap* new_shared_heap() {
+  int shm = memfd_create("hvml-heap", 0);
+  if (shm < 0) {
+    return NULL;
+  }
+  Heap* heap = ftruncate(shm, SHM_SIZE) == 0 ? attach_heap(shm) : NULL;
+  if (heap == NULL) {
+    close(shm);
+    return NULL;
+  }
+  atomic_store_explicit(heap->ini, 0, memory_order_relaxed);
+  atomic_store_explicit(heap->end, 1, memory_order_relaxed);
+  atomic_store_explicit(heap->itr, 0, memory_order_relaxed);
+  atomic_store_explicit(heap->hlt, 0, memory_order_relaxed);
+  return heap;
+}
+
+void free_heap(Heap* heap) {
+  if (heap->shm < 0) {
+    free(heap->stk);
+    free(heap->mem);
+    free(heap->ini);
+    free(heap->end);
+    free(heap->itr);
+    free(heap->hlt);
+  } else {
+    free_stack(heap->stk);
+    munmap(heap->ini, SHM_SIZE);
+    close(heap->shm);
+  }
+  free(heap);
+}
+
 Term new_term(Tag tag, Lab lab, Loc loc) {
   Term tag_enc = tag;
   Term lab_enc = ((Term)lab) << 8;
@@ -98,6 +199,10 @@ Loc get_itr(Heap* heap) {
   return atomic_load_explicit(heap->itr, memory_order_relaxed);
 }
 
+u64 get_hlt(Heap* heap) {
+  return atomic_load_explicit(heap->hlt, memory_order_relaxed);
+}
+
 void set_ini(Heap* heap, Loc value) {
   atomic_store_explicit(heap->ini, value, memory_order_relaxed);
 }
@@ -110,6 +215,10 @@ void set_itr(Heap* heap, Loc value) {
   atomic_store_explicit(heap->itr, value, memory_order_relaxed);
 }
 
+void set_hlt(Heap* heap, u64 value) {
+  atomic_store_explicit(heap->hlt, value, memory_order_relaxed);
+}
+
 // Memory
 // ------
 
@@ -129,6 +238,72 @@ Term take(Heap* heap, Loc loc) {
   return swap(heap, loc, VOID);
 }
 
+// Dup Locks
+// ---------
+
+// On a shared heap, a worker that reduces or normalizes a dup's value holds
+// it: the value's slot is replaced by a LCK term naming the owner's pid, and
+// written back when the worker is done. Others wait for it. If the owner died
+// holding it, the heap may have half-written interactions, so it is poisoned
+// (HLT_PSN) and every worker stops. On a private heap there is nobody to race
+// with, and values are just read.
+
+// Returns the value at `loc` and holds it, or the LCK term if already held
+Term hold(Heap* heap, Loc loc) {
+  Term val = got(heap, loc);
+  if (heap->shm < 0) {
+    return val;
+  }
+  Term lck = new_term(LCK, 0, heap->pid);
+  while (get_tag(val) != LCK) {
+    if (atomic_compare_exchange_weak_explicit(&heap->mem[loc], &val, lck, memory_order_relaxed, memory_order_relaxed)) {
+      return val;
+    }
+  }
+  return val;
+}
+
+// A process counts as dead once it is gone or a zombie
+int is_alive(Loc pid) {
+  if (kill(pid, 0) != 0 && errno == ESRCH) {
+    return 0;
+  }
+  char path[64];
+  char stat[256];
+  snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return 1;
+  }
+  size_t len = fread(stat, 1, sizeof(stat) - 1, file);
+  fclose(file);
+  stat[len] = 0;
+  char* end = strrchr(stat, ')');
+  return end == NULL || (end[2] != 'Z' && end[2] != 'X');
+}
+
+// Called while waiting on a dup's held value; poisons the heap if its owner
+// died before resolving the dup
+void wait_hold(Heap* heap, Term dup, Term lck, u64* spin) {
+  if (++(*spin) % 4096 == 0 && !is_alive(get_loc(lck)) && get_tag(got(heap, get_key(dup))) == SUB) {
+    set_hlt(heap, HLT_PSN);
+  }
+}
+
+// Holds the value of a stuck dup, to normalize it. Returns a LCK term if
+// another worker resolved the dup meanwhile, or the heap was halted.
+Term hold_dup(Heap* heap, Term dup) {
+  u64 spin = 0;
+  while (get_tag(got(heap, get_key(dup))) == SUB && !get_hlt(heap)) {
+    Term val = hold(heap, get_loc(dup) + 2);
+    if (get_tag(val) != LCK) {
+      return val;
+    }
+    wait_hold(heap, dup, val, &spin);
+  }
+  return new_term(LCK, 0, 0);
+}
+
 // Allocation
 // ----------
 
@@ -146,6 +321,7 @@ Loc inc_itr(Heap* heap) {
 void print_tag(Tag tag) {
   switch (tag) {
     case SUB: printf("SUB"); break;
+    case LCK: printf("LCK"); break;
     case VAR: printf("VAR"); break;
     case DP0: printf("DP0"); break;
     case DP1: printf("DP1"); break;
@@ -163,6 +339,56 @@ void print_term(Term term) {
   printf(",0x%06x,0x%09x)", get_lab(term), get_loc(term));
 }
 
+// Prints a normal form as a λ-term. Variables are named after their lambda's
+// location, and a dup that is still stuck shows as `d<loc>_<side>`.
+void print_norm(Heap* heap, Term term) {
+  Loc loc = get_loc(term);
+  switch (get_tag(term)) {
+    case VAR:
+    case DP0:
+    case DP1: {
+      Term sub = got(heap, get_key(term));
+      if (get_tag(sub) != SUB) {
+        print_norm(heap, sub);
+      } else if (get_tag(term) == VAR) {
+        printf("x%x", loc);
+      } else {
+        printf("d%x_%u", loc, get_tag(term));
+      }
+      break;
+    }
+    case LAM: {
+      printf("λx%x.", loc);
+      print_norm(heap, got(heap, loc + 1));
+      break;
+    }
+    case APP: {
+      printf("(");
+      print_norm(heap, got(heap, loc + 0));
+      printf(" ");
+      print_norm(heap, got(heap, loc + 1));
+      printf(")");
+      break;
+    }
+    case SUP: {
+      printf("&%u{", get_lab(term));
+      print_norm(heap, got(heap, loc + 0));
+      printf(" ");
+      print_norm(heap, got(heap, loc + 1));
+      printf("}");
+      break;
+    }
+    case ERA: {
+      printf("*");
+      break;
+    }
+    default: {
+      printf("?");
+      break;
+    }
+  }
+}
+
 void print_heap(Heap* heap) {
   Loc end = get_end(heap);
   for (Loc i = 0; i < end; i++) {
@@ -200,14 +426,15 @@ Term reduce_app_lam(Heap* heap, Term app, Term lam) {
   return bod;
 }
 
-// ({a b} c)
-// --------------- APP_SUP
-// & {x0 x1} = c
-// {(a x0) (b x1)}
+// (&L{a b} c)
+// ----------------- APP_SUP
+// & L{x0 x1} = c
+// &L{(a x0) (b x1)}
 Term reduce_app_sup(Heap* heap, Term app, Term sup) {
   inc_itr(heap);
   Loc app_loc = get_loc(app);
   Loc sup_loc = get_loc(sup);
+  Lab sup_lab = get_lab(sup);
   Term arg    = got(heap, app_loc + 1);
   Term tm0    = got(heap, sup_loc + 0);
   Term tm1    = got(heap, sup_loc + 1);
@@ -219,16 +446,16 @@ Term reduce_app_sup(Heap* heap, Term app, Term sup) {
   set(heap, du0 + 1, new_term(SUB, 0, 0));
   set(heap, du0 + 2, arg);
   set(heap, ap0 + 0, tm0);
-  set(heap, ap0 + 1, new_term(DP0, 0, du0));
+  set(heap, ap0 + 1, new_term(DP0, sup_lab, du0));
   set(heap, ap1 + 0, tm1);
-  set(heap, ap1 + 1, new_term(DP1, 0, du0));
+  set(heap, ap1 + 1, new_term(DP1, sup_lab, du0));
   set(heap, su0 + 0, new_term(APP, 0, ap0));
   set(heap, su0 + 1, new_term(APP, 0, ap1));
-  return new_term(SUP, 0, su0);
+  return new_term(SUP, sup_lab, su0);
 }
 
-// & {x y} = *
-// ----------- DUP_ERA
+// & L{x y} = *
+// ------------ DUP_ERA
 // x <- *
 // y <- *
 Term reduce_dup_era(Heap* heap, Term dup, Term era) {
@@ -240,15 +467,16 @@ Term reduce_dup_era(Heap* heap, Term dup, Term era) {
   return got(heap, dup_loc + dup_num);
 }
 
-// & {r s} = λx(f)
-// --------------- DUP_LAM
-// & {f0 f1} = f
+// & L{r s} = λx(f)
+// ---------------- DUP_LAM
+// & L{f0 f1} = f
 // r <- λx0(f0)
 // s <- λx1(f1)
-// x <- {x0 x1}
+// x <- &L{x0 x1}
 Term reduce_dup_lam(Heap* heap, Term dup, Term lam) {
   inc_itr(heap);
   Loc dup_loc = get_loc(dup);
+  Lab dup_lab = get_lab(dup);
   Tag dup_num = get_tag(dup) == DP0 ? 0 : 1;
   Loc lam_loc = get_loc(lam);
   Term bod    = got(heap, lam_loc + 1);
@@ -260,36 +488,66 @@ Term reduce_dup_lam(Heap* heap, Term dup, Term lam) {
   set(heap, du0 + 1, new_term(SUB, 0, 0));
   set(heap, du0 + 2, bod);
   set(heap, lm0 + 0, new_term(SUB, 0, 0));
-  set(heap, lm0 + 1, new_term(DP0, 0, du0));
+  set(heap, lm0 + 1, new_term(DP0, dup_lab, du0));
   set(heap, lm1 + 0, new_term(SUB, 0, 0));
-  set(heap, lm1 + 1, new_term(DP1, 0, du0));
+  set(heap, lm1 + 1, new_term(DP1, dup_lab, du0));
   set(heap, su0 + 0, new_term(VAR, 0, lm0));
   set(heap, su0 + 1, new_term(VAR, 0, lm1));
   set(heap, dup_loc + 0, new_term(LAM, 0, lm0));
   set(heap, dup_loc + 1, new_term(LAM, 0, lm1));
-  set(heap, lam_loc + 0, new_term(SUP, 0, su0));
+  set(heap, lam_loc + 0, new_term(SUP, dup_lab, su0));
   return got(heap, dup_loc + dup_num);
 }
 
-// & {x y} = {a b}
-// --------------- DUP_SUP
+// & L{x y} = &L{a b}
+// ------------------ DUP_SUP (same label)
 // x <- a
 // y <- b
+//
+// & L{x y} = &K{a b}
+// ------------------ DUP_SUP (different label)
+// x <- &K{a0 b0}
+// y <- &K{a1 b1}
+// & L{a0 a1} = a
+// & L{b0 b1} = b
 Term reduce_dup_sup(Heap* heap, Term dup, Term sup) {
   inc_itr(heap);
   Loc dup_loc = get_loc(dup);
+  Lab dup_lab = get_lab(dup);
   Tag dup_num = get_tag(dup) == DP0 ? 0 : 1;
   Loc sup_loc = get_loc(sup);
+  Lab sup_lab = get_lab(sup);
   Term tm0    = got(heap, sup_loc + 0);
   Term tm1    = got(heap, sup_loc + 1);
-  set(heap, dup_loc + 0, tm0);
-  set(heap, dup_loc + 1, tm1);
-  return got(heap, dup_loc + dup_num);
+  if (dup_lab == sup_lab) {
+    set(heap, dup_loc + 0, tm0);
+    set(heap, dup_loc + 1, tm1);
+    return got(heap, dup_loc + dup_num);
+  } else {
+    Loc du0 = alloc_node(heap, 3);
+    Loc du1 = alloc_node(heap, 3);
+    Loc su0 = alloc_node(heap, 2);
+    Loc su1 = alloc_node(heap, 2);
+    set(heap, du0 + 0, new_term(SUB, 0, 0));
+    set(heap, du0 + 1, new_term(SUB, 0, 0));
+    set(heap, du0 + 2, tm0);
+    set(heap, du1 + 0, new_term(SUB, 0, 0));
+    set(heap, du1 + 1, new_term(SUB, 0, 0));
+    set(heap, du1 + 2, tm1);
+    set(heap, su0 + 0, new_term(DP0, dup_lab, du0));
+    set(heap, su0 + 1, new_term(DP0, dup_lab, du1));
+    set(heap, su1 + 0, new_term(DP1, dup_lab, du0));
+    set(heap, su1 + 1, new_term(DP1, dup_lab, du1));
+    set(heap, dup_loc + 0, new_term(SUP, sup_lab, su0));
+    set(heap, dup_loc + 1, new_term(SUP, sup_lab, su1));
+    return got(heap, dup_loc + dup_num);
+  }
 }
 
 Term reduce(Heap* heap, Term term) {
   Term* path = heap->stk;
   Loc   spos = 0;
+  u64   spin = 0;
   Term  next = term;
   while (1) {
     Tag tag = get_tag(next);
@@ -306,8 +564,18 @@ Term reduce(Heap* heap, Term term) {
         Loc key = get_key(next);
         Term sub = got(heap, key);
         if (get_tag(sub) == SUB) {
+          // Holds the dup's value, so that no other worker interacts with it.
+          // If it is already held, waits until that worker is done with it.
+          Term val = hold(heap, loc + 2);
+          if (get_tag(val) == LCK) {
+            wait_hold(heap, next, val, &spin);
+            if (get_hlt(heap)) {
+              break;
+            }
+            continue;
+          }
           path[spos++] = next;
-          next = got(heap, loc + 2);
+          next = val;
           continue;
         } else {
           next = sub;
@@ -361,6 +629,13 @@ Term reduce(Heap* heap, Term term) {
     if (spos == 0) {
       return next;
     } else {
+      // Gives back the values of the dups held on the way down.
+      for (Loc i = 0; heap->shm >= 0 && i + 1 < spos; i++) {
+        Tag itag = get_tag(path[i]);
+        if (itag == DP0 || itag == DP1) {
+          set(heap, get_loc(path[i]) + 2, path[i + 1]);
+        }
+      }
       Term host = path[--spos];
       Tag  htag = get_tag(host);
       Lab  hlab = get_lab(host);
@@ -377,6 +652,9 @@ Term reduce(Heap* heap, Term term) {
 }
 
 Term normal(Heap* heap, Term term) {
+  if (get_hlt(heap)) {
+    return term;
+  }
   Term wnf = reduce(heap, term);
   Tag tag = get_tag(wnf);
   Lab lab = get_lab(wnf);
@@ -411,17 +689,85 @@ Term normal(Heap* heap, Term term) {
       set(heap, loc + 1, tm1);
       return wnf;
     }
-    case DP0: {
+    case DP0:
+    case DP1: {
       Term val;
-      val = got(heap, loc + 2);
+      val = hold_dup(heap, wnf);
+      if (get_tag(val) == LCK) {
+        return get_hlt(heap) ? wnf : normal(heap, wnf);
+      }
       val = normal(heap, val);
       set(heap, loc + 2, val);
       return wnf;
     }
+    default:
+      return wnf;
+  }
+}
+
+// Parallel Normalization
+// ----------------------
+
+// Like `normal`, but forks a worker process to normalize one side of each
+// APP/SUP, down to `lvl` levels, so up to 2^lvl processes reduce the shared
+// heap at once. Dups shared by both sides are held while in use, so each one
+// is reduced once. A worker that crashes is counted in `err`, and poisons the
+// heap, since it may have died mid-interaction: the other workers then stop
+// instead of waiting on it, and the result must not be trusted.
+Term normal_par(Heap* heap, Term term, Loc lvl, Loc* err) {
+  if (lvl == 0 || get_hlt(heap)) {
+    return normal(heap, term);
+  }
+  Term wnf = reduce(heap, term);
+  Tag tag = get_tag(wnf);
+  Loc loc = get_loc(wnf);
+  switch (tag) {
+    case APP:
+    case SUP: {
+      pid_t pid = fork();
+      if (pid == 0) {
+        Loc sub = 0;
+        heap->pid = getpid();
+        Term tm0 = normal_par(heap, got(heap, loc + 0), lvl - 1, &sub);
+        set(heap, loc + 0, tm0);
+        _exit(sub == 0 ? 0 : 1);
+      }
+      Term tm1;
+      tm1 = got(heap, loc + 1);
+      tm1 = normal_par(heap, tm1, lvl - 1, err);
+      set(heap, loc + 1, tm1);
+      if (pid < 0) {
+        Term tm0;
+        tm0 = got(heap, loc + 0);
+        tm0 = normal_par(heap, tm0, lvl - 1, err);
+        set(heap, loc + 0, tm0);
+      } else {
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status)) {
+          set_hlt(heap, HLT_PSN);
+          *err += 1;
+        } else if (WEXITSTATUS(status) != 0) {
+          *err += 1;
+        }
+      }
+      return wnf;
+    }
+    case LAM: {
+      Term bod;
+      bod = got(heap, loc + 1);
+      bod = normal_par(heap, bod, lvl, err);
+      set(heap, loc + 1, bod);
+      return wnf;
+    }
+    case DP0:
     case DP1: {
       Term val;
-      val = got(heap, loc + 2);
-      val = normal(heap, val);
+      val = hold_dup(heap, wnf);
+      if (get_tag(val) == LCK) {
+        return get_hlt(heap) ? wnf : normal_par(heap, wnf, lvl, err);
+      }
+      val = normal_par(heap, val, lvl, err);
       set(heap, loc + 2, val);
       return wnf;
     }
@@ -430,9 +776,164 @@ Term normal(Heap* heap, Term term) {
   }
 }
 
+// Collapse
+// --------
+
+// Enumerates the branches of a top-level superposition and normalizes them on
+// `n` threads sharing a queue. Each branch remembers the side it chose for
+// every label on its way down. A branch that reduces to a SUP whose label was
+// already chosen follows that side; otherwise it is split back into the queue,
+// once per side. The first branch whose normal form isn't `*` wins, and raises
+// `hlt` so that the others stop early. Returns `*` if every branch was erased.
+// SUPs inside a branch's normal form (rather than at its head) are kept as-is.
+//
+// The heap must be shared (see `new_shared_heap`): threads already share
+// memory, but only shared heaps lock dups that several branches reach.
+
+#define COL_DEPTH 64
+
+typedef struct {
+  Term term;            // branch root
+  Loc  dep;             // number of labels chosen
+  u64  sel[COL_DEPTH];  // chosen label/side pairs, as (lab << 1) | side
+} Branch;
+
+typedef struct {
+  Heap*           heap; // shared heap
+  Branch*         buf;  // pending branches
+  Loc             len;  // pending branch count
+  Loc             cap;  // pending branch capacity
+  Loc             act;  // threads holding a branch
+  Term            res;  // first successful branch
+  pthread_mutex_t mtx;
+  pthread_cond_t  cnd;
+} Collapse;
+
+static void push_branch(Collapse* col, Branch* br) {
+  if (col->len == col->cap) {
+    col->cap *= 2;
+    col->buf  = realloc(col->buf, col->cap * sizeof(Branch));
+  }
+  col->buf[col->len++] = *br;
+}
+
+// Returns the side this branch chose for `lab`, or -1 if it didn't yet
+static int branch_side(Branch* br, Lab lab) {
+  for (Loc i = 0; i < br->dep; i++) {
+    if ((br->sel[i] >> 1) == lab) {
+      return br->sel[i] & 1;
+    }
+  }
+  return -1;
+}
+
+static void* collapse_worker(void* arg) {
+  Collapse* col = arg;
+  Heap view = *col->heap;
+  view.stk = new_stack();
+  if (view.stk == NULL) {
+    return NULL;
+  }
+  while (1) {
+    pthread_mutex_lock(&col->mtx);
+    while (col->len == 0 && col->act > 0 && !get_hlt(&view)) {
+      pthread_cond_wait(&col->cnd, &col->mtx);
+    }
+    if (col->len == 0 || get_hlt(&view)) {
+      pthread_cond_broadcast(&col->cnd);
+      pthread_mutex_unlock(&col->mtx);
+      break;
+    }
+    Branch br = col->buf[--col->len];
+    col->act++;
+    pthread_mutex_unlock(&col->mtx);
+
+    Term wnf = reduce(&view, br.term);
+    int  side = get_tag(wnf) == SUP ? branch_side(&br, get_lab(wnf)) : -1;
+    if (get_tag(wnf) == SUP && (side >= 0 || br.dep < COL_DEPTH)) {
+      Loc loc = get_loc(wnf);
+      Lab lab = get_lab(wnf);
+      pthread_mutex_lock(&col->mtx);
+      if (side >= 0) {
+        br.term = got(&view, loc + side);
+        push_branch(col, &br);
+      } else {
+        br.dep++;
+        br.term = got(&view, loc + 1);
+        br.sel[br.dep - 1] = ((u64)lab << 1) | 1;
+        push_branch(col, &br);
+        br.term = got(&view, loc + 0);
+        br.sel[br.dep - 1] = ((u64)lab << 1) | 0;
+        push_branch(col, &br);
+      }
+      col->act--;
+      pthread_cond_broadcast(&col->cnd);
+      pthread_mutex_unlock(&col->mtx);
+      continue;
+    }
+
+    Term val = normal(&view, wnf);
+    pthread_mutex_lock(&col->mtx);
+    if (get_tag(val) != ERA && !get_hlt(&view)) {
+      col->res = val;
+      set_hlt(&view, HLT_STOP);
+    }
+    col->act--;
+    pthread_cond_broadcast(&col->cnd);
+    pthread_mutex_unlock(&col->mtx);
+  }
+  free_stack(view.stk);
+  return NULL;
+}
+
+Term collapse(Heap* heap, Term term, Loc n) {
+  Collapse col;
+  col.heap = heap;
+  col.cap  = 256;
+  col.buf  = malloc(col.cap * sizeof(Branch));
+  col.len  = 0;
+  col.act  = 0;
+  col.res  = new_term(ERA, 0, 0);
+  pthread_mutex_init(&col.mtx, NULL);
+  pthread_cond_init(&col.cnd, NULL);
+
+  Branch root;
+  root.term = term;
+  root.dep  = 0;
+  push_branch(&col, &root);
+
+  // The calling thread works too, so `n` threads run in total
+  pthread_t* ths = malloc(n * sizeof(pthread_t));
+  Loc spawned = 0;
+  for (Loc i = 1; i < n; i++) {
+    if (pthread_create(&ths[spawned], NULL, collapse_worker, &col) == 0) {
+      spawned++;
+    }
+  }
+  collapse_worker(&col);
+  for (Loc i = 0; i < spawned; i++) {
+    pthread_join(ths[i], NULL);
+  }
+  if (get_hlt(heap) == HLT_STOP) {
+    set_hlt(heap, 0);
+  }
+
+  pthread_mutex_destroy(&col.mtx);
+  pthread_cond_destroy(&col.cnd);
+  free(ths);
+  free(col.buf);
+  return col.res;
+}
+
 // Main
 // ----
 
+// Builds with `-DINJECT='"file.c"'` load `inject_main` from that file (as
+// emitted by the compiler's compileToHVML) instead, and print the result.
+#ifdef INJECT
+#include INJECT
+#endif
+
 static void inject_P24(Heap* heap) {
   set_ini(heap, 0x000000000);
   set_end(heap, 0x0000000f1);
@@ -680,28 +1181,78 @@ static void inject_P24(Heap* heap) {
   set(heap, 0x0000000f0, new_term(VAR,0x000000,0x0000000ed));
 }
 
-int main() {
-  Heap* heap = new_heap();
+// Parses a thread/worker count, clamped to MAX_WORKERS; 0 if invalid
+static Loc parse_count(const char* arg) {
+  int n = atoi(arg);
+  if (n < 1) {
+    return 0;
+  }
+  return n > MAX_WORKERS ? MAX_WORKERS : n;
+}
+
+int main(int argc, char** argv) {
+  // With `-c`, collapses the root superposition on that many threads
+  int is_col = argc > 1 && strcmp(argv[1], "-c") == 0;
+  Loc col = is_col && argc > 2 ? parse_count(argv[2]) : 0;
+
+  // With a worker count, normalizes on a shared heap with forked workers
+  Loc wrk = !is_col && argc > 1 ? parse_count(argv[1]) : 0;
+  if ((is_col && col == 0) || (!is_col && argc > 1 && wrk == 0)) {
+    fprintf(stderr, "Usage: %s [workers | -c threads], with 1 to %d of them\n", argv[0], MAX_WORKERS);
+    return 1;
+  }
+  Loc lvl = 0;
+  while ((1ULL << lvl) < wrk) {
+    lvl++;
+  }
+
+  Heap* heap = wrk > 0 || col > 0 ? new_shared_heap() : new_heap();
+  if (heap == NULL) {
+    fprintf(stderr, "Failed to create shared heap\n");
+    return 1;
+  }
+#ifdef INJECT
+  inject_main(heap);
+#else
   inject_P24(heap);
+#endif
 
-  clock_t start = clock();
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
 
   // Normalize and get interaction count
   Term root = got(heap, 0);
-  normal(heap, root);
-  clock_t end = clock();
+  Loc  errs = 0;
+  Term norm;
+  if (col > 0) {
+    norm = collapse(heap, root, col);
+    printf("Branch: %s\n", get_tag(norm) == ERA ? "none" : "found");
+  } else {
+    norm = normal_par(heap, root, lvl, &errs);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  if (errs > 0) {
+    fprintf(stderr, "Workers failed: %u\n", errs);
+  }
+  if (get_hlt(heap) == HLT_PSN) {
+    fprintf(stderr, "Heap poisoned by a crashed worker; result discarded\n");
+    free_heap(heap);
+    return 1;
+  }
 
   printf("Itrs: %u\n", get_itr(heap));
-  double time_spent = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+  double time_spent = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
   printf("Size: %u nodes\n", get_end(heap));
   printf("Time: %.2f seconds\n", time_spent / 1000.0);
   printf("MIPS: %.2f\n", (get_itr(heap) / 1000000.0) / (time_spent / 1000.0));
 
-  free(heap->stk);
-  free(heap->mem);
-  free(heap->ini);
-  free(heap->end);
-  free(heap->itr);
-  free(heap);
-  return 0;
-}
\ No newline at end of file
+#ifdef INJECT
+  printf("Norm: ");
+  print_norm(heap, norm);
+  printf("\n");
+#endif
+
+  free_heap(heap);
+  return errs > 0 ? 1 : 0;
+}
@@ -1,11 +1,41 @@
 let { InteractionNet } = require('./engine');
 
+// HVML.c term tags
+const Tag = {
+  DP0: 0x00,
+  DP1: 0x01,
+  VAR: 0x02,
+  APP: 0x03,
+  ERA: 0x04,
+  LAM: 0x05,
+  SUP: 0x06,
+  SUB: 0x07
+};
+
+const TagName = ['DP0', 'DP1', 'VAR', 'APP', 'ERA', 'LAM', 'SUP', 'SUB'];
+
+// Labels are 24 bits wide in HVML.c
+const MAX_LABEL = 0xFFFFFF;
+
+// Partial evaluation gives up on a term that grows past this factor
+const MAX_GROWTH = 4;
+
 // Parser and compiler for lambda calculus to interaction nets
 class LambdaCompiler {
-  constructor() {
+  // options.budget: reductions the partial evaluator may spend per compile;
+  //   whatever is left when it runs out is left for the runtime (0 disables it)
+  // options.inlineSize: largest lambda it will copy into several use sites
+  constructor(options = {}) {
     this.pos = 0;
     this.input = '';
     this.variableScope = new Map();
+    this.usedLabels = new Set();
+    this.nextLabel = 0;
+    this.budget = options.budget ?? 10000;
+    this.inlineSize = options.inlineSize ?? 8;
+    this.steps = 0;
+    this.nextName = 0;
+    this.sizes = new WeakMap();
   }
 
   // Lexer helper methods
@@ -57,10 +87,55 @@ class LambdaCompiler {
     };
   }
 
+  parseLabel() {
+    this.skipWhitespace();
+    const start = this.pos;
+    while (this.pos < this.input.length && /[0-9]/.test(this.input[this.pos])) {
+      this.pos++;
+    }
+    if (start === this.pos) {
+      throw new Error(`Expected label after & at position ${this.pos}`);
+    }
+    const label = parseInt(this.input.slice(start, this.pos), 10);
+    if (label > MAX_LABEL) {
+      throw new Error(`Label ${label} is out of range at position ${start}`);
+    }
+    return label;
+  }
+
+  // {a b} gets a fresh label, &L{a b} uses label L
+  parseSuperposition() {
+    let label = null;
+    if (this.peek() === '&') {
+      this.consume();
+      label = this.parseLabel();
+      this.usedLabels.add(label);
+    }
+    if (this.consume() !== '{') {
+      throw new Error(`Expected { at position ${this.pos}`);
+    }
+    const left = this.parseAtom();
+    const right = this.parseAtom();
+    if (this.consume() !== '}') {
+      throw new Error(`Expected } at position ${this.pos}`);
+    }
+    return {
+      type: 'superposition',
+      label: label,
+      left: left,
+      right: right
+    };
+  }
+
   parseAtom() {
     const char = this.peek();
     
-    if (char === '(') {
+    if (char === '{' || char === '&') {
+      return this.parseSuperposition();
+    } else if (char === '*') {
+      this.consume();
+      return { type: 'erasure' };
+    } else if (char === '(') {
       this.consume(); // consume '('
       const expr = this.parseExpression();
       if (this.consume() !== ')') {
@@ -77,7 +152,7 @@ class LambdaCompiler {
   parseApplication() {
     let left = this.parseAtom();
     
-    while (this.peek() && this.peek() !== ')') {
+    while (this.peek() && this.peek() !== ')' && this.peek() !== '}') {
       const right = this.parseAtom();
       left = {
         type: 'application',
@@ -97,7 +172,32 @@ class LambdaCompiler {
     this.input = input;
     this.pos = 0;
     this.variableScope.clear();
-    return this.parseExpression();
+    this.usedLabels.clear();
+    this.nextLabel = 0;
+    const ast = this.parseExpression();
+    this.labelSuperpositions(ast);
+    return ast;
+  }
+
+  // Gives each unlabeled {a b} its fresh label once all explicit ones are
+  // known, so that copies made by the partial evaluator keep sharing it
+  labelSuperpositions(ast) {
+    switch (ast.type) {
+      case 'abstraction':
+        this.labelSuperpositions(ast.body);
+        break;
+      case 'application':
+        this.labelSuperpositions(ast.func);
+        this.labelSuperpositions(ast.arg);
+        break;
+      case 'superposition':
+        if (ast.label === null) {
+          ast.label = this.freshLabel();
+        }
+        this.labelSuperpositions(ast.left);
+        this.labelSuperpositions(ast.right);
+        break;
+    }
   }
 
   // Compiler methods
@@ -135,9 +235,348 @@ class LambdaCompiler {
         const arg = this.compileToNet(ast.arg, net);
         return net.createApplication(func, arg);
 
+      case 'superposition':
+        throw new Error('Superpositions can only be emitted to an HVML heap');
+
+      case 'erasure':
+        throw new Error('Erasures can only be emitted to an HVML heap');
+
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+  }
+
+  // Partial evaluation methods
+  //
+  // Runs between parsing and heap emission, so that work that doesn't depend
+  // on input is done once at build time. Works bottom-up: each subterm with a
+  // redex is normalized and replaced if it reaches a normal form before the
+  // budget runs out and got no bigger. Otherwise it is left for the runtime.
+  // Arguments that are about to be erased are not evaluated at all.
+
+  optimize(ast) {
+    this.steps = 0;
+    return this.evaluate(ast);
+  }
+
+  evaluate(ast) {
+    let term;
+    switch (ast.type) {
+      case 'erasure':
+      case 'variable':
+        return ast;
+      case 'abstraction':
+        term = { ...ast, body: this.evaluate(ast.body) };
+        break;
+      case 'application': {
+        const func = this.evaluate(ast.func);
+        const erased = func.type === 'erasure' || (func.type === 'abstraction' && this.countUses(func.body, func.param) === 0);
+        term = { ...ast, func: func, arg: erased ? ast.arg : this.evaluate(ast.arg) };
+        break;
+      }
+      case 'superposition':
+        term = { ...ast, left: this.evaluate(ast.left), right: this.evaluate(ast.right) };
+        break;
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+    if (!this.hasRedex(term)) {
+      return term;
+    }
+    const normal = this.normalize(term);
+    return normal && this.size(normal) <= this.size(term) ? normal : term;
+  }
+
+  // Normal-order reduction; returns null when out of budget or growing too much
+  normalize(ast) {
+    const limit = this.size(ast) * MAX_GROWTH;
+    let term = ast;
+    let next;
+    while (this.steps < this.budget) {
+      if ((next = this.step(term)) === null) {
+        return term;
+      }
+      if (this.size(next) > limit) {
+        return null;
+      }
+      this.steps++;
+      term = next;
+    }
+    return null;
+  }
+
+  // Performs the leftmost-outermost reducible redex, or returns null. A redex
+  // whose argument is used more than once is only reducible if copying the
+  // argument loses no sharing: a variable or a small lambda.
+  step(ast) {
+    switch (ast.type) {
+      case 'erasure':
+      case 'variable':
+        return null;
+
+      case 'abstraction': {
+        const body = this.step(ast.body);
+        return body && { ...ast, body: body };
+      }
+
+      case 'application': {
+        const func = ast.func;
+        if (func.type === 'erasure') {
+          return func;
+        }
+        if (func.type === 'abstraction' && this.isInlinable(func, ast.arg)) {
+          return this.substitute(func.body, func.param, ast.arg);
+        }
+        const newFunc = this.step(func);
+        if (newFunc) {
+          return { ...ast, func: newFunc };
+        }
+        const newArg = this.step(ast.arg);
+        return newArg && { ...ast, arg: newArg };
+      }
+
+      case 'superposition': {
+        const left = this.step(ast.left);
+        if (left) {
+          return { ...ast, left: left };
+        }
+        const right = this.step(ast.right);
+        return right && { ...ast, right: right };
+      }
+
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+  }
+
+  // Dead and linear bindings are always inlined; the argument of a dead one
+  // is simply erased.
+  isInlinable(lam, arg) {
+    if (this.countUses(lam.body, lam.param) <= 1) {
+      return true;
+    }
+    switch (arg.type) {
+      case 'erasure':
+      case 'variable':
+        return true;
+      case 'abstraction':
+        return this.size(arg) <= this.inlineSize;
+      default:
+        return false;
+    }
+  }
+
+  hasRedex(ast) {
+    switch (ast.type) {
+      case 'erasure':
+      case 'variable':
+        return false;
+      case 'abstraction':
+        return this.hasRedex(ast.body);
+      case 'application':
+        return ast.func.type === 'abstraction' || ast.func.type === 'erasure' || this.hasRedex(ast.func) || this.hasRedex(ast.arg);
+      case 'superposition':
+        return this.hasRedex(ast.left) || this.hasRedex(ast.right);
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+  }
+
+  // Sizes are memoized per node: terms are never mutated after parsing, and a
+  // reduction step only creates new nodes along the path it rewrote
+  size(ast) {
+    let size = this.sizes.get(ast);
+    if (size !== undefined) {
+      return size;
+    }
+    switch (ast.type) {
+      case 'erasure':
+      case 'variable':
+        size = 1;
+        break;
+      case 'abstraction':
+        size = 1 + this.size(ast.body);
+        break;
+      case 'application':
+        size = 1 + this.size(ast.func) + this.size(ast.arg);
+        break;
+      case 'superposition':
+        size = 1 + this.size(ast.left) + this.size(ast.right);
+        break;
       default:
         throw new Error(`Unknown AST node type: ${ast.type}`);
     }
+    this.sizes.set(ast, size);
+    return size;
+  }
+
+  freeVars(ast, bound = new Set(), free = new Set()) {
+    switch (ast.type) {
+      case 'variable':
+        if (!bound.has(ast.name)) {
+          free.add(ast.name);
+        }
+        return free;
+      case 'erasure':
+        return free;
+      case 'abstraction':
+        return this.freeVars(ast.body, new Set(bound).add(ast.param), free);
+      case 'application':
+        this.freeVars(ast.func, bound, free);
+        return this.freeVars(ast.arg, bound, free);
+      case 'superposition':
+        this.freeVars(ast.left, bound, free);
+        return this.freeVars(ast.right, bound, free);
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+  }
+
+  // Capture-avoiding substitution of `value` for `name` in `ast`. Renamed
+  // binders get multi-character names, which the parser never produces.
+  substitute(ast, name, value, free = this.freeVars(value)) {
+    switch (ast.type) {
+      case 'variable':
+        return ast.name === name ? value : ast;
+
+      case 'erasure':
+        return ast;
+
+      case 'abstraction': {
+        if (ast.param === name) {
+          return ast;
+        }
+        if (free.has(ast.param)) {
+          const param = `${ast.param}_${this.nextName++}`;
+          const body = this.substitute(ast.body, ast.param, { type: 'variable', name: param });
+          return { ...ast, param: param, body: this.substitute(body, name, value, free) };
+        }
+        return { ...ast, body: this.substitute(ast.body, name, value, free) };
+      }
+
+      case 'application':
+        return {
+          ...ast,
+          func: this.substitute(ast.func, name, value, free),
+          arg: this.substitute(ast.arg, name, value, free)
+        };
+
+      case 'superposition':
+        return {
+          ...ast,
+          left: this.substitute(ast.left, name, value, free),
+          right: this.substitute(ast.right, name, value, free)
+        };
+
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+  }
+
+  // Heap emission methods (HVML.c memory layout)
+
+  // Allocates a label that no explicit &L{..} in the source uses
+  freshLabel() {
+    while (this.usedLabels.has(this.nextLabel)) {
+      this.nextLabel++;
+    }
+    if (this.nextLabel > MAX_LABEL) {
+      throw new Error('Ran out of labels');
+    }
+    this.usedLabels.add(this.nextLabel);
+    return this.nextLabel++;
+  }
+
+  countUses(ast, name) {
+    switch (ast.type) {
+      case 'variable':
+        return ast.name === name ? 1 : 0;
+      case 'erasure':
+        return 0;
+      case 'abstraction':
+        return ast.param === name ? 0 : this.countUses(ast.body, name);
+      case 'application':
+        return this.countUses(ast.func, name) + this.countUses(ast.arg, name);
+      case 'superposition':
+        return this.countUses(ast.left, name) + this.countUses(ast.right, name);
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+  }
+
+  // Returns one term per use of a variable bound at `src`. A variable used
+  // more than once is copied by a chain of dups, each with a fresh label.
+  bindUses(heap, src, uses) {
+    const terms = [];
+    let cur = src;
+    for (let i = 1; i < uses; i++) {
+      const dup = heap.alloc(3);
+      const lab = this.freshLabel();
+      heap.set(dup + 0, Tag.SUB, 0, 0);
+      heap.set(dup + 1, Tag.SUB, 0, 0);
+      heap.set(dup + 2, cur.tag, cur.lab, cur.loc);
+      terms.push({ tag: Tag.DP0, lab: lab, loc: dup });
+      cur = { tag: Tag.DP1, lab: lab, loc: dup };
+    }
+    terms.push(cur);
+    return terms;
+  }
+
+  compileToHeap(ast, heap, scope = new Map()) {
+    switch (ast.type) {
+      case 'variable': {
+        const uses = scope.get(ast.name);
+        if (!uses) {
+          throw new Error(`Unbound variable ${ast.name}`);
+        }
+        return uses.shift();
+      }
+
+      case 'erasure':
+        return { tag: Tag.ERA, lab: 0, loc: 0 };
+
+      case 'abstraction': {
+        const lam = heap.alloc(2);
+        heap.set(lam + 0, Tag.SUB, 0, 0);
+        const uses = this.bindUses(heap, { tag: Tag.VAR, lab: 0, loc: lam }, this.countUses(ast.body, ast.param));
+        const inner = new Map(scope);
+        inner.set(ast.param, uses);
+        const body = this.compileToHeap(ast.body, heap, inner);
+        heap.set(lam + 1, body.tag, body.lab, body.loc);
+        return { tag: Tag.LAM, lab: 0, loc: lam };
+      }
+
+      case 'application': {
+        const app = heap.alloc(2);
+        const func = this.compileToHeap(ast.func, heap, scope);
+        const arg = this.compileToHeap(ast.arg, heap, scope);
+        heap.set(app + 0, func.tag, func.lab, func.loc);
+        heap.set(app + 1, arg.tag, arg.lab, arg.loc);
+        return { tag: Tag.APP, lab: 0, loc: app };
+      }
+
+      case 'superposition': {
+        const sup = heap.alloc(2);
+        const lab = ast.label;
+        const left = this.compileToHeap(ast.left, heap, scope);
+        const right = this.compileToHeap(ast.right, heap, scope);
+        heap.set(sup + 0, left.tag, left.lab, left.loc);
+        heap.set(sup + 1, right.tag, right.lab, right.loc);
+        return { tag: Tag.SUP, lab: lab, loc: sup };
+      }
+
+      default:
+        throw new Error(`Unknown AST node type: ${ast.type}`);
+    }
+  }
+
+  // Compiles to an inject function that HVML.c can load into its heap
+  compileToHVML(input, name = 'main') {
+    const ast = this.optimize(this.parse(input));
+    const heap = new HeapImage();
+    const root = this.compileToHeap(ast, heap);
+    heap.set(0, root.tag, root.lab, root.loc);
+    return heap.toInject(name);
   }
 
   // Main compilation method
@@ -149,7 +588,45 @@ class LambdaCompiler {
   }
 }
 
+// Flat term memory in the layout HVML.c uses; location 0 holds the root
+class HeapImage {
+  constructor() {
+    this.mem = [null];
+    this.end = 1;
+  }
+
+  alloc(arity) {
+    const loc = this.end;
+    this.end += arity;
+    while (this.mem.length < this.end) {
+      this.mem.push(null);
+    }
+    return loc;
+  }
+
+  set(at, tag, lab, loc) {
+    this.mem[at] = { tag: tag, lab: lab, loc: loc };
+  }
+
+  toInject(name) {
+    const hex = (n, w) => '0x' + n.toString(16).padStart(w, '0');
+    const lines = [];
+    lines.push(`static void inject_${name}(Heap* heap) {`);
+    lines.push(`  set_ini(heap, ${hex(0, 9)});`);
+    lines.push(`  set_end(heap, ${hex(this.end, 9)});`);
+    lines.push(`  set_itr(heap, ${hex(0, 9)});`);
+    this.mem.forEach((term, loc) => {
+      if (term) {
+        lines.push(`  set(heap, ${hex(loc, 9)}, new_term(${TagName[term.tag]},${hex(term.lab, 6)},${hex(term.loc, 9)}));`);
+      }
+    });
+    lines.push('}');
+    return lines.join('\n');
+  }
+}
 
 module.exports = {
-  LambdaCompiler
+  LambdaCompiler,
+  HeapImage,
+  Tag
 }
\ No newline at end of file
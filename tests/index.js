@@ -1,4 +1,9 @@
 let { LambdaCompiler } = require('../src/compiler');
+const assert = require('assert');
+const { execFileSync } = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
 
 // Example usage showing the compilation and reduction process
 function evaluateLambdaExpression(expr) {
@@ -31,3 +36,91 @@ testCases.forEach(test => {
   console.log('='.repeat(50));
   evaluateLambdaExpression(test);
 });
+
+// Heap emission for HVML.c, with labeled superpositions
+const hvmlCases = [
+  'λf.(λx.(f (f x)))',                  // Auto-dup with a fresh label
+  '(λx.&2{x x}) &1{(λa.a) (λb.b)}',    // DUP-SUP commutation
+  '&1{(λa.a) (λb.b)} &1{(λc.c) (λd.d)}' // DUP-SUP annihilation
+];
+
+hvmlCases.forEach(test => {
+  console.log('='.repeat(50));
+  console.log(`Emitting: ${test}\n`);
+  console.log(new LambdaCompiler().compileToHVML(test));
+});
+
+// Compile-time partial evaluation before emission
+const optimizeCases = [
+  '(λf.(λx.(f (f x)))) (λy.y) (λz.z)',          // Closed redexes, inlined small lambda
+  '(λx.(λy.x)) (λa.a) ((λx.(x x)) (λx.(x x)))', // Dead binding erases a divergent term
+  'λn.((λf.(f (f n))) (n n))'                   // Input-dependent, left for the runtime
+];
+
+optimizeCases.forEach(test => {
+  console.log('='.repeat(50));
+  console.log(`Optimizing: ${test}\n`);
+  console.log('Without partial evaluation:');
+  console.log(new LambdaCompiler({ budget: 0 }).compileToHVML(test));
+  console.log('\nWith partial evaluation:');
+  console.log(new LambdaCompiler().compileToHVML(test));
+});
+
+// Runs an emitted net on HVML.c and returns its readback, with variables and
+// labels renamed by order of appearance so that layouts can be compared
+const buildDir = fs.mkdtempSync(path.join(os.tmpdir(), 'benben-'));
+
+function runHVML(expr, args = ['1'], options = {}) {
+  const inject = path.join(buildDir, 'inject.c');
+  const binary = path.join(buildDir, 'hvml');
+  fs.writeFileSync(inject, new LambdaCompiler(options).compileToHVML(expr));
+  execFileSync('cc', ['-O2', '-w', `-DINJECT="${inject}"`, '-o', binary, path.join(__dirname, '../HVML.c'), '-lpthread']);
+  const output = execFileSync(binary, args).toString();
+  const norm = output.split('\n').find(line => line.startsWith('Norm: ')).slice(6);
+  const names = new Map();
+  const labels = new Map();
+  return norm
+    .replace(/\b[xd][0-9a-f]+(_[01])?\b/g, name => {
+      if (!names.has(name)) names.set(name, `v${names.size}`);
+      return names.get(name);
+    })
+    .replace(/&[0-9]+/g, label => {
+      if (!labels.has(label)) labels.set(label, `&${labels.size}`);
+      return labels.get(label);
+    });
+}
+
+const runtimeCases = [
+  // DUP-SUP commutation
+  ['(λx.&2{x x}) &1{(λa.a) (λb.b)}', ['1'], '&0{&1{λv0.v0 λv1.v1} &1{λv2.v2 λv3.v3}}'],
+  // DUP-SUP annihilation
+  ['&1{(λa.a) (λb.b)} &1{(λc.c) (λd.(λe.e))}', ['1'], '&0{λv0.v0 λv1.λv2.v2}'],
+  // Collapse only enumerates consistent worlds: a and d, not b and c
+  ['&1{&1{* (λb.b)} &1{(λc.c) (λd.(λe.e))}}', ['-c', '1'], 'λv0.λv1.v1'],
+  ['&1{&1{* (λb.b)} &1{(λc.c) (λd.(λe.e))}}', ['-c', '4'], 'λv0.λv1.v1'],
+  ['&1{&2{* (λb.b)} &2{(λc.c) (λd.(λe.e))}}', ['-c', '1'], 'λv0.v0']
+];
+
+console.log('='.repeat(50));
+runtimeCases.forEach(([test, args, expected]) => {
+  const result = runHVML(test, args);
+  console.log(`Running: ${test} [${args.join(' ')}]\n  ${result}`);
+  assert.strictEqual(result, expected);
+});
+
+// Partial evaluation must not change what the runtime computes
+const equivalenceCases = [
+  '(λf.((f (λa.a)) (f (λb.b)))) (λy.{y y})',    // Copied lambdas keep their SUP label
+  '(λf.(λx.(f (f x)))) (λy.y) (λz.z)',
+  '(λx.(λy.x)) (λa.a) ((λx.(x x)) (λx.(x x)))', // Erased divergent argument
+  '(* (λa.a))',                                 // ERA-applied
+  '(λx.&2{x x}) &1{(λa.a) (λb.b)}'
+];
+
+equivalenceCases.forEach(test => {
+  const plain = runHVML(test, ['1'], { budget: 0 });
+  const optimized = runHVML(test, ['1']);
+  console.log(`Comparing: ${test}\n  ${plain}\n  ${optimized}`);
+  assert.strictEqual(optimized, plain);
+});
+fs.rmSync(buildDir, { recursive: true });